@@ -0,0 +1,410 @@
+/*
+  ==============================================================================
+
+    Headless bridge: forwards a local (or virtual) MIDI port to the 3DS and
+    back, without a DAW, an editor or an audio device. Uses the same MidiLink
+    as the plugin.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include "MidiLink.h"
+
+namespace
+{
+    std::atomic<bool> shouldQuit { false };
+
+    void handleSignal (int)
+    {
+        shouldQuit = true;
+    }
+
+    // The I/O thread renders the link in blocks of this virtual sample rate
+    constexpr double bridgeSampleRate = 48000.0;
+    constexpr int cycleMs = 1;
+
+    const char* const usage =
+        "Usage: NoiseCommander3DSBridge [options]\n"
+        "\n"
+        "  --ds-ip=<address>     3DS IP address (default: the one the plugin saved)\n"
+        "  --midi-in=<name>      local MIDI input to forward to the 3DS\n"
+        "  --midi-out=<name>     local MIDI output for messages from the 3DS\n"
+        "  --virtual             create virtual MIDI ports instead (default if no ports given)\n"
+        "  --clock-sync          exchange clock sync packets with the 3DS; only for a 3DS\n"
+        "                        build that answers them, others would read them as MIDI\n"
+        "  --stats=<seconds>     interval of the stats printed to stdout (default 5, 0 = off)\n"
+        "  --config=<file>       read options from a file, one 'key = value' per line,\n"
+        "                        keys as above without the dashes; the command line wins\n"
+        "  --list                list MIDI devices and exit\n"
+        "  --help                show this text\n";
+
+    //==============================================================================
+    struct BridgeConfig
+    {
+        juce::String dsIpAddress;
+        juce::String midiInName;
+        juce::String midiOutName;
+        bool useVirtualPorts = false;
+        bool clockSync = false;
+        int statsIntervalSeconds = 5;
+    };
+
+    juce::StringPairArray readConfigFile (const juce::File& file)
+    {
+        juce::StringPairArray values;
+        juce::StringArray lines;
+        file.readLines (lines);
+
+        for (auto line : lines)
+        {
+            line = line.upToFirstOccurrenceOf ("#", false, false).trim();
+
+            if (line.containsChar ('='))
+                values.set (line.upToFirstOccurrenceOf ("=", false, false).trim(),
+                            line.fromFirstOccurrenceOf ("=", false, false).trim().unquoted());
+        }
+
+        return values;
+    }
+
+    juce::String getSavedIpAddress()
+    {
+        // Same settings file as the plugin, so a discovered 3DS is picked up here too
+        juce::PropertiesFile::Options options;
+        options.applicationName     = "NoiseCommander3DS_VST3";
+        options.filenameSuffix      = "settings";
+        options.osxLibrarySubFolder = "Application Support";
+
+        juce::PropertiesFile props (options);
+        return props.getValue ("3ds_ip", "192.168.1.0");
+    }
+
+    bool parseConfig (const juce::ArgumentList& args, BridgeConfig& config)
+    {
+        juce::StringPairArray values;
+
+        if (args.containsOption ("--config"))
+        {
+            const auto file = juce::File::getCurrentWorkingDirectory()
+                                   .getChildFile (args.getValueForOption ("--config").unquoted());
+
+            if (! file.existsAsFile())
+            {
+                std::cerr << "Config file not found: " << file.getFullPathName() << std::endl;
+                return false;
+            }
+
+            values = readConfigFile (file);
+        }
+
+        auto option = [&] (const juce::String& name) -> juce::String
+        {
+            if (args.containsOption ("--" + name))
+                return args.getValueForOption ("--" + name);
+
+            return values[name];
+        };
+
+        config.dsIpAddress = option ("ds-ip");
+        config.midiInName  = option ("midi-in");
+        config.midiOutName = option ("midi-out");
+        config.useVirtualPorts = args.containsOption ("--virtual") || values["virtual"].getIntValue() != 0
+                                                                   || values["virtual"] == "true";
+        config.clockSync = args.containsOption ("--clock-sync") || values["clock-sync"].getIntValue() != 0
+                                                                || values["clock-sync"] == "true";
+
+        const auto stats = option ("stats");
+
+        if (stats.isNotEmpty())
+            config.statsIntervalSeconds = juce::jmax (0, stats.getIntValue());
+
+        if (config.dsIpAddress.isEmpty())
+            config.dsIpAddress = getSavedIpAddress();
+
+        if (config.midiInName.isEmpty() && config.midiOutName.isEmpty())
+            config.useVirtualPorts = true;
+        else if (config.useVirtualPorts)
+        {
+            // Each direction has a single port, so one of them would silently replace the other
+            std::cerr << "--virtual cannot be combined with --midi-in or --midi-out" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    template <typename DeviceType>
+    juce::MidiDeviceInfo findDevice (const juce::String& name)
+    {
+        for (const auto& info : DeviceType::getAvailableDevices())
+            if (info.name == name || info.identifier == name)
+                return info;
+
+        return {};
+    }
+
+    void listDevices()
+    {
+        std::cout << "MIDI inputs:" << std::endl;
+
+        for (const auto& info : juce::MidiInput::getAvailableDevices())
+            std::cout << "  " << info.name << "  [" << info.identifier << "]" << std::endl;
+
+        std::cout << "MIDI outputs:" << std::endl;
+
+        for (const auto& info : juce::MidiOutput::getAvailableDevices())
+            std::cout << "  " << info.name << "  [" << info.identifier << "]" << std::endl;
+    }
+
+    //==============================================================================
+    /**
+        Moves MIDI between the local ports and the link on a realtime thread, in
+        the same way processBlock() does in the plugin.
+    */
+    class BridgeIoThread  : public juce::Thread,
+                            public juce::MidiInputCallback
+    {
+    public:
+        explicit BridgeIoThread (MidiLink& linkToUse)
+            : juce::Thread ("3DS bridge I/O"),
+              link (linkToUse)
+        {
+            collector.reset (bridgeSampleRate);
+            link.prepare (bridgeSampleRate);
+        }
+
+        ~BridgeIoThread() override
+        {
+            stopThread (1000);
+        }
+
+        // Set before the thread is started
+        void setOutput (juce::MidiOutput* outputToUse)
+        {
+            output = outputToUse;
+        }
+
+        void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message) override
+        {
+            collector.addMessageToQueue (message);
+
+            // Forward it now rather than at the end of the cycle
+            notify();
+        }
+
+        // Time from a local MIDI input event to its UDP send, since the last call
+        MidiLink::LatencyStats takeOutboundLatencyStats()
+        {
+            return outboundLatency.take();
+        }
+
+    private:
+        void run() override
+        {
+            juce::MidiBuffer toDs, fromDs;
+            double lastCycleMs = juce::Time::getMillisecondCounterHiRes();
+
+            while (! threadShouldExit())
+            {
+                const double nowMs = juce::Time::getMillisecondCounterHiRes();
+                const int numSamples = juce::jmax (1, juce::roundToInt ((nowMs - lastCycleMs) * bridgeSampleRate * 0.001));
+                lastCycleMs = nowMs;
+
+                // Local MIDI in -> UDP
+                toDs.clear();
+                collector.removeNextBlockOfMessages (toDs, numSamples);
+
+                for (const auto metadata : toDs)
+                {
+                    link.sendMessage (metadata.getMessage());
+
+                    // The collector places each message by its arrival, relative to the end of the block
+                    outboundLatency.add ((numSamples - metadata.samplePosition) * 1000.0 / bridgeSampleRate);
+                }
+
+                // UDP -> local MIDI out
+                fromDs.clear();
+                link.receiveMessages (fromDs, numSamples);
+
+                // Played out at their sample positions by the output's own thread
+                if (output != nullptr && ! fromDs.isEmpty())
+                    output->sendBlockOfMessages (fromDs, juce::Time::getMillisecondCounterHiRes(), bridgeSampleRate);
+
+                // Sleeps until the next cycle, or until local input arrives
+                wait (cycleMs);
+            }
+        }
+
+        MidiLink& link;
+        juce::MidiOutput* output = nullptr;
+        juce::MidiMessageCollector collector;
+
+        MidiLink::LatencyMeter outboundLatency;
+    };
+
+    //==============================================================================
+    void printStats (MidiLink& link, BridgeIoThread& ioThread, double elapsedSeconds)
+    {
+        static juce::uint64 lastMessagesSent = 0, lastBytesSent = 0;
+        static juce::uint64 lastMessagesReceived = 0, lastBytesReceived = 0;
+
+        const auto messagesSent = link.messagesSent.load();
+        const auto bytesSent = link.bytesSent.load();
+        const auto messagesReceived = link.messagesReceived.load();
+        const auto bytesReceived = link.bytesReceived.load();
+
+        auto rate = [elapsedSeconds] (juce::uint64 now, juce::uint64& last)
+        {
+            const auto delta = (double) (now - last);
+            last = now;
+            return juce::String (delta / elapsedSeconds, 1);
+        };
+
+        const auto outLatency = ioThread.takeOutboundLatencyStats();
+        const auto inLatency = link.takeInboundLatencyStats();
+        const auto mapping = link.clockSync->getMapping();
+
+        juce::String line;
+        line << "out " << rate (messagesSent, lastMessagesSent) << " msg/s "
+                       << rate (bytesSent, lastBytesSent) << " B/s"
+             << " | in " << rate (messagesReceived, lastMessagesReceived) << " msg/s "
+                         << rate (bytesReceived, lastBytesReceived) << " B/s"
+             << " | latency out " << juce::String (outLatency.averageMs, 2) << "/" << juce::String (outLatency.maxMs, 2) << " ms"
+             << " in " << juce::String (inLatency.averageMs, 2) << "/" << juce::String (inLatency.maxMs, 2) << " ms";
+
+        if (mapping.valid)
+            line << " | rtt " << juce::String (mapping.roundTripMs, 2) << " ms"
+                 << " drift " << juce::String (mapping.driftPpm, 1) << " ppm";
+
+        if (link.clockFollower.isLocked())
+            line << " | clock " << juce::String (link.clockFollower.getTempoBpm(), 1) << " BPM"
+                 << " jitter " << juce::String (link.clockFollower.getInputJitterMs(), 2)
+                 << "/" << juce::String (link.clockFollower.getOutputJitterMs(), 2) << " ms";
+
+        if (link.getNumDroppedPackets() > 0)
+            line << " | dropped " << link.getNumDroppedPackets();
+
+        std::cout << line << std::endl;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        std::cout << usage;
+        return 0;
+    }
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    if (args.containsOption ("--list"))
+    {
+        listDevices();
+        return 0;
+    }
+
+    BridgeConfig config;
+
+    if (! parseConfig (args, config))
+        return 1;
+
+    std::signal (SIGINT, handleSignal);
+    std::signal (SIGTERM, handleSignal);
+
+    MidiLink link;
+    link.setTarget (config.dsIpAddress);
+    link.clockSync->setEnabled (config.clockSync);
+
+    BridgeIoThread ioThread (link);
+
+    // Declared after the thread so they are closed before it goes away
+    std::unique_ptr<juce::MidiInput> input;
+    std::unique_ptr<juce::MidiOutput> output;
+
+    if (config.useVirtualPorts)
+    {
+        input = juce::MidiInput::createNewDevice ("NoiseCommander3DS to 3DS", &ioThread);
+        output = juce::MidiOutput::createNewDevice ("NoiseCommander3DS from 3DS");
+    }
+
+    if (config.midiInName.isNotEmpty())
+    {
+        const auto info = findDevice<juce::MidiInput> (config.midiInName);
+
+        if (info.identifier.isEmpty())
+        {
+            std::cerr << "MIDI input not found: " << config.midiInName << std::endl;
+            return 1;
+        }
+
+        input = juce::MidiInput::openDevice (info.identifier, &ioThread);
+    }
+
+    if (config.midiOutName.isNotEmpty())
+    {
+        const auto info = findDevice<juce::MidiOutput> (config.midiOutName);
+
+        if (info.identifier.isEmpty())
+        {
+            std::cerr << "MIDI output not found: " << config.midiOutName << std::endl;
+            return 1;
+        }
+
+        output = juce::MidiOutput::openDevice (info.identifier);
+    }
+
+    // sendBlockOfMessages() needs it
+    if (output != nullptr)
+        output->startBackgroundThread();
+
+    if (input == nullptr && output == nullptr)
+    {
+        std::cerr << "No MIDI port could be opened" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Bridging "
+              << (input != nullptr ? input->getName() : juce::String ("-")) << " / "
+              << (output != nullptr ? output->getName() : juce::String ("-"))
+              << " <-> 3DS at " << config.dsIpAddress << std::endl;
+
+    ioThread.setOutput (output.get());
+
+    if (! ioThread.startRealtimeThread (juce::Thread::RealtimeOptions{}.withPeriodMs (cycleMs)))
+    {
+        std::cerr << "Could not get realtime priority, falling back to high priority" << std::endl;
+        ioThread.startThread (juce::Thread::Priority::highest);
+    }
+
+    if (input != nullptr)
+        input->start();
+
+    auto lastStatsMs = juce::Time::getMillisecondCounterHiRes();
+
+    while (! shouldQuit)
+    {
+        juce::Thread::sleep (100);
+
+        const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+
+        if (config.statsIntervalSeconds > 0 && nowMs - lastStatsMs >= config.statsIntervalSeconds * 1000.0)
+        {
+            printStats (link, ioThread, (nowMs - lastStatsMs) * 0.001);
+            lastStatsMs = nowMs;
+        }
+    }
+
+    if (input != nullptr)
+        input->stop();
+
+    ioThread.stopThread (1000);
+    return 0;
+}
@@ -0,0 +1,320 @@
+/*
+  ==============================================================================
+
+    NTP-style offset and drift estimation against the 3DS clock.
+
+  ==============================================================================
+*/
+
+#include "ClockSync.h"
+
+namespace
+{
+    constexpr char magic[] = { 'N', 'C', 'S', 'Y' };
+    constexpr juce::uint8 requestType = 1;
+    constexpr juce::uint8 replyType = 2;
+
+    constexpr int requestIntervalMs = 250;
+
+    // Replies slower than this are not worth keeping, and stale ones are ignored
+    constexpr double maxRoundTripMs = 1000.0;
+
+    // Exchanges per min-RTT bin; with 128 samples this is a 32 s window of 16 points
+    constexpr int binSize = 8;
+
+    // Anything beyond this is a bad fit, not a real crystal
+    constexpr double maxDriftPpm = 1000.0;
+
+    juce::int64 toMicroseconds (double ms)   { return (juce::int64) std::llround (ms * 1000.0); }
+    double toMilliseconds (juce::int64 us)   { return (double) us * 0.001; }
+
+    void writeInt64 (juce::uint8* dest, juce::int64 value)
+    {
+        const auto le = juce::ByteOrder::swapIfBigEndian ((juce::uint64) value);
+        std::memcpy (dest, &le, sizeof (le));
+    }
+
+    juce::int64 readInt64 (const juce::uint8* source)
+    {
+        return (juce::int64) juce::ByteOrder::littleEndianInt64 (source);
+    }
+}
+
+//==============================================================================
+ClockSync::ClockSync()
+    : juce::Thread ("3DS clock sync"),
+      hostClock ([] { return juce::Time::getMillisecondCounterHiRes(); })
+{
+}
+
+ClockSync::~ClockSync()
+{
+    stop();
+    socket.shutdown();
+}
+
+void ClockSync::start()
+{
+    startThread();
+}
+
+void ClockSync::stop()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (1000);
+}
+
+void ClockSync::setTarget (const juce::String& ipAddress, int port)
+{
+    {
+        const juce::ScopedLock sl (targetLock);
+
+        if (ipAddress == targetIP && port == targetPort)
+            return;
+
+        targetIP = ipAddress;
+        targetPort = port;
+    }
+
+    reset();
+}
+
+void ClockSync::setEnabled (bool shouldBeEnabled)
+{
+    if (enabled.exchange (shouldBeEnabled) == shouldBeEnabled)
+        return;
+
+    reset();
+
+    // Start the exchanges right away instead of after the next interval
+    if (shouldBeEnabled)
+        notify();
+}
+
+void ClockSync::reset()
+{
+    // Both locks, so no request taken before this can count afterwards
+    const juce::ScopedLock tl (targetLock);
+    const juce::ScopedLock sl (sampleLock);
+
+    firstValidSequence = nextSequence.load();
+    numSamples = 0;
+    sampleWriteIndex = 0;
+    publish ({});
+}
+
+ClockMapping ClockSync::getMapping() const noexcept
+{
+    // publish() only takes a few stores, so a retry is rare and short
+    for (;;)
+    {
+        const auto version = mappingVersion.load (std::memory_order_acquire);
+
+        if ((version & 1) != 0)
+            continue;
+
+        ClockMapping mapping;
+        mapping.valid           = mappingValid.load (std::memory_order_relaxed);
+        mapping.referenceHostMs = mappingReferenceHostMs.load (std::memory_order_relaxed);
+        mapping.offsetMs        = mappingOffsetMs.load (std::memory_order_relaxed);
+        mapping.driftPpm        = mappingDriftPpm.load (std::memory_order_relaxed);
+        mapping.roundTripMs     = mappingRoundTripMs.load (std::memory_order_relaxed);
+        mapping.residualMs      = mappingResidualMs.load (std::memory_order_relaxed);
+
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        if (mappingVersion.load (std::memory_order_relaxed) == version)
+            return mapping;
+    }
+}
+
+void ClockSync::publish (const ClockMapping& mapping)
+{
+    // Writers are serialised by sampleLock
+    const auto version = mappingVersion.load (std::memory_order_relaxed);
+    mappingVersion.store (version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    mappingValid.store (mapping.valid, std::memory_order_relaxed);
+    mappingReferenceHostMs.store (mapping.referenceHostMs, std::memory_order_relaxed);
+    mappingOffsetMs.store (mapping.offsetMs, std::memory_order_relaxed);
+    mappingDriftPpm.store (mapping.driftPpm, std::memory_order_relaxed);
+    mappingRoundTripMs.store (mapping.roundTripMs, std::memory_order_relaxed);
+    mappingResidualMs.store (mapping.residualMs, std::memory_order_relaxed);
+
+    mappingVersion.store (version + 2, std::memory_order_release);
+}
+
+//==============================================================================
+void ClockSync::run()
+{
+    while (! threadShouldExit())
+    {
+        if (enabled.load())
+            sendRequest();
+
+        wait (requestIntervalMs);
+    }
+}
+
+bool ClockSync::makeRequest (juce::uint8* packet)
+{
+    const juce::ScopedLock sl (targetLock);
+
+    if (targetIP.isEmpty() || targetPort <= 0)
+        return false;
+
+    std::memset (packet, 0, packetSize);
+    std::memcpy (packet, magic, sizeof (magic));
+    packet[4] = requestType;
+
+    const auto sequence = juce::ByteOrder::swapIfBigEndian (nextSequence++);
+    std::memcpy (packet + 8, &sequence, sizeof (sequence));
+
+    writeInt64 (packet + 12, toMicroseconds (hostClock()));
+    return true;
+}
+
+void ClockSync::sendRequest()
+{
+    juce::uint8 packet[packetSize];
+
+    if (! makeRequest (packet))
+        return;
+
+    // Read after the request was made: if the target changed in between, the
+    // reply to this sequence number is ignored anyway
+    juce::String ip;
+    int port;
+
+    {
+        const juce::ScopedLock sl (targetLock);
+        ip = targetIP;
+        port = targetPort;
+    }
+
+    socket.write (ip, port, packet, packetSize);
+}
+
+bool ClockSync::handlePacket (const juce::uint8* data, int size, double arrivalMs)
+{
+    if (size < packetSize || std::memcmp (data, magic, sizeof (magic)) != 0)
+        return false;
+
+    if (data[4] != replyType)
+        return true;
+
+    juce::uint32 sequence;
+    std::memcpy (&sequence, data + 8, sizeof (sequence));
+    sequence = juce::ByteOrder::swapIfBigEndian (sequence);
+
+    const double t1 = toMilliseconds (readInt64 (data + 12));
+    const double t2 = toMilliseconds (readInt64 (data + 20));
+    const double t3 = toMilliseconds (readInt64 (data + 28));
+    const double t4 = arrivalMs;
+
+    const double roundTripMs = (t4 - t1) - (t3 - t2);
+
+    if (t4 < t1 || roundTripMs < 0.0 || roundTripMs > maxRoundTripMs)
+        return true;
+
+    addSample ({ 0.5 * (t1 + t4), 0.5 * ((t2 - t1) + (t3 - t4)), roundTripMs }, sequence);
+    return true;
+}
+
+void ClockSync::addSample (const Sample& sample, juce::uint32 sequence)
+{
+    const juce::ScopedLock sl (sampleLock);
+
+    // Only numbers handed out since the last reset, in wrap-around arithmetic
+    if (sequence - firstValidSequence >= nextSequence.load() - firstValidSequence)
+        return;
+
+    samples[(size_t) sampleWriteIndex] = sample;
+    sampleWriteIndex = (sampleWriteIndex + 1) % maxSamples;
+    numSamples = juce::jmin (numSamples + 1, maxSamples);
+
+    updateMapping();
+}
+
+//==============================================================================
+void ClockSync::updateMapping()
+{
+    // Min-RTT filter: the fastest exchange of each bin, oldest bin first. A
+    // trailing partial bin only counts once it has a fair chance of a fast one.
+    std::array<Sample, maxSamples / binSize + 1> points;
+    int numPoints = 0;
+    double minRoundTripMs = maxRoundTripMs;
+
+    const int oldest = (sampleWriteIndex - numSamples + maxSamples) % maxSamples;
+
+    for (int binStart = 0; binStart < numSamples; binStart += binSize)
+    {
+        const int binEnd = juce::jmin (binStart + binSize, numSamples);
+
+        if (binEnd - binStart < binSize / 2 && numPoints > 0)
+            break;
+
+        const Sample* best = nullptr;
+
+        for (int i = binStart; i < binEnd; ++i)
+        {
+            const auto& s = samples[(size_t) ((oldest + i) % maxSamples)];
+
+            if (best == nullptr || s.roundTripMs < best->roundTripMs)
+                best = &s;
+        }
+
+        points[(size_t) numPoints++] = *best;
+        minRoundTripMs = juce::jmin (minRoundTripMs, best->roundTripMs);
+    }
+
+    if (numPoints == 0)
+        return;
+
+    ClockMapping mapping;
+    mapping.valid = true;
+    mapping.roundTripMs = minRoundTripMs;
+    mapping.referenceHostMs = points[(size_t) numPoints - 1].hostMs;
+
+    // Least squares offset = a + b * (host - mean), evaluated at the newest point
+    double meanX = 0.0, meanY = 0.0;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        meanX += points[(size_t) i].hostMs;
+        meanY += points[(size_t) i].offsetMs;
+    }
+
+    meanX /= numPoints;
+    meanY /= numPoints;
+
+    double sxx = 0.0, sxy = 0.0;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const double dx = points[(size_t) i].hostMs - meanX;
+        sxx += dx * dx;
+        sxy += dx * (points[(size_t) i].offsetMs - meanY);
+    }
+
+    const double slope = (numPoints >= 3 && sxx > 0.0) ? sxy / sxx : 0.0;
+    const double clampedSlope = juce::jlimit (-maxDriftPpm * 1.0e-6, maxDriftPpm * 1.0e-6, slope);
+
+    mapping.driftPpm = clampedSlope * 1.0e6;
+    mapping.offsetMs = meanY + clampedSlope * (mapping.referenceHostMs - meanX);
+
+    double residualSquared = 0.0;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto& p = points[(size_t) i];
+        const double fitted = meanY + clampedSlope * (p.hostMs - meanX);
+        residualSquared += (p.offsetMs - fitted) * (p.offsetMs - fitted);
+    }
+
+    mapping.residualMs = std::sqrt (residualSquared / numPoints);
+
+    publish (mapping);
+}
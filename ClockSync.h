@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    Estimates how the 3DS clock relates to Time::getMillisecondCounterHiRes(),
+    NTP-style, over the existing UDP link.
+
+    A background thread sends a timestamped request a few times per second;
+    the 3DS answers with its own receive and send times. Each exchange gives an
+    offset and a round-trip delay. Exchanges are grouped into bins and only
+    the one with the smallest round trip in each bin is kept (min-RTT filter),
+    since queueing on Wi-Fi only ever adds delay. A linear regression over the
+    kept samples gives the current offset and the drift between the clocks.
+
+    Wire format, all fields little-endian, 36 bytes in both directions:
+
+        0   "NCSY"
+        4   type: 1 = request (host -> 3DS), 2 = reply (3DS -> host)
+        5   3 bytes reserved, zero
+        8   uint32 sequence number, echoed in the reply
+        12  int64 t1: host send time in microseconds, echoed in the reply
+        20  int64 t2: 3DS receive time in microseconds (reply only)
+        28  int64 t3: 3DS send time in microseconds (reply only)
+
+    Requests are sent from a socket of their own to the 3DS MIDI port; replies
+    come back to the port the 3DS sends MIDI to, where handlePacket() picks
+    them out before any MIDI parsing. A reply only counts if it echoes a
+    sequence number sent since the last reset(), so replies meant for an
+    earlier target or an earlier session are ignored.
+
+    The packets are not MIDI. A 3DS build that does not know this protocol
+    would read the magic as data bytes under running status, and the
+    timestamps can contain status bytes. Requests are therefore only sent
+    once enabled with setEnabled().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <functional>
+
+//==============================================================================
+/**
+    Maps host time to 3DS time:
+        remote = host + offsetMs + (host - referenceHostMs) * driftPpm * 1e-6
+*/
+struct ClockMapping
+{
+    bool valid = false;
+    double referenceHostMs = 0.0;
+    double offsetMs = 0.0;
+    double driftPpm = 0.0;
+    double roundTripMs = 0.0;   // smallest round trip in the window
+    double residualMs = 0.0;    // RMS deviation of the kept samples from the fit
+
+    double hostToRemoteMs (double hostMs) const noexcept
+    {
+        return hostMs + offsetMs + (hostMs - referenceHostMs) * driftPpm * 1.0e-6;
+    }
+
+    double remoteToHostMs (double remoteMs) const noexcept
+    {
+        const double drift = driftPpm * 1.0e-6;
+        return (remoteMs - offsetMs + referenceHostMs * drift) / (1.0 + drift);
+    }
+};
+
+//==============================================================================
+/**
+*/
+class ClockSync  : private juce::Thread
+{
+public:
+    static constexpr int packetSize = 36;
+
+    ClockSync();
+    ~ClockSync() override;
+
+    void start();
+    void stop();
+
+    void setTarget (const juce::String& ipAddress, int port);
+
+    // Requests are only sent while enabled; off by default
+    void setEnabled (bool shouldBeEnabled);
+    bool isEnabled() const noexcept { return enabled.load(); }
+
+    // Host time for the request timestamps, Time::getMillisecondCounterHiRes()
+    // unless replaced, e.g. by a test. Must match the arrival times passed to
+    // handlePacket(). Set before start().
+    std::function<double()> hostClock;
+
+    // Fills in the next request to the current target and returns false if
+    // there is none. The sync thread sends these; tests can answer them directly.
+    bool makeRequest (juce::uint8* packet);
+
+    // Called from the receiver thread for every datagram. Returns true if it
+    // was a sync reply, which is then consumed here.
+    bool handlePacket (const juce::uint8* data, int size, double arrivalMs);
+
+    // Takes no lock, safe to call from the audio thread
+    ClockMapping getMapping() const noexcept;
+
+    // Drops all samples, e.g. after the 3DS address changed
+    void reset();
+
+private:
+    struct Sample
+    {
+        double hostMs;      // midpoint of t1 and t4
+        double offsetMs;
+        double roundTripMs;
+    };
+
+    void run() override;
+    void sendRequest();
+    void addSample (const Sample& sample, juce::uint32 sequence);
+    void updateMapping();
+    void publish (const ClockMapping& mapping);
+
+    juce::DatagramSocket socket;
+    std::atomic<bool> enabled { false };
+
+    juce::CriticalSection targetLock;
+    juce::String targetIP;
+    int targetPort = 0;
+
+    // Taken under targetLock, so a request carries a number from after the last reset
+    std::atomic<juce::uint32> nextSequence { 0 };
+
+    static constexpr int maxSamples = 128;
+    juce::CriticalSection sampleLock;
+    std::array<Sample, maxSamples> samples;
+    int numSamples = 0;
+    int sampleWriteIndex = 0;
+    juce::uint32 firstValidSequence = 0;
+
+    // Seqlock: the version is odd while publish() is writing, and readers retry
+    // if it was odd or changed while they copied the fields
+    std::atomic<juce::uint32> mappingVersion { 0 };
+    std::atomic<bool> mappingValid { false };
+    std::atomic<double> mappingReferenceHostMs { 0.0 }, mappingOffsetMs { 0.0 }, mappingDriftPpm { 0.0 };
+    std::atomic<double> mappingRoundTripMs { 0.0 }, mappingResidualMs { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClockSync)
+};
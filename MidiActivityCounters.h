@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    Per-channel MIDI traffic counters. The audio thread only increments
+    atomics here; the editor samples them on a timer to drive the activity
+    panel, so no strings are formatted on the audio thread just to show that
+    something is flowing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/**
+*/
+struct MidiActivityCounters
+{
+    static constexpr int numChannels = 16;
+
+    struct Channel
+    {
+        std::atomic<juce::uint32> messages { 0 };
+        std::atomic<juce::uint32> notes { 0 };
+    };
+
+    struct Direction
+    {
+        std::array<Channel, numChannels> channels;
+
+        void count (const juce::uint8* data, int size) noexcept
+        {
+            // System messages (SysEx, clock, transport) have no channel
+            if (size <= 0 || data[0] < 0x80 || data[0] >= 0xf0)
+                return;
+
+            const auto status = data[0];
+
+            auto& channel = channels[(size_t) (status & 0x0f)];
+            channel.messages.fetch_add (1, std::memory_order_relaxed);
+
+            if ((status & 0xf0) == 0x90 && size >= 3 && data[2] > 0)
+                channel.notes.fetch_add (1, std::memory_order_relaxed);
+        }
+    };
+
+    Direction in, out;
+};
@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+    Per-channel MIDI activity panel.
+
+  ==============================================================================
+*/
+
+#include "MidiActivityPanel.h"
+
+namespace
+{
+    constexpr int updateRateHz = 20;
+    constexpr int maxLevel = 255;
+    constexpr double rateSmoothing = 0.3;
+
+    juce::String formatCount (juce::uint32 count)
+    {
+        if (count < 1000)
+            return juce::String (count);
+
+        if (count < 1000000)
+            return juce::String (count / 1000) + "k";
+
+        return juce::String (count / 1000000) + "M";
+    }
+}
+
+//==============================================================================
+MidiActivityPanel::MidiActivityPanel (MidiActivityCounters& countersToShow)
+    : counters (countersToShow)
+{
+    setOpaque (true);
+
+    // Start from the current totals so the first update is not a huge burst
+    for (int direction = 0; direction < numDirections; ++direction)
+        for (int channel = 0; channel < numChannels; ++channel)
+            cells[direction][channel].messages = getCounters (direction).channels[(size_t) channel].messages.load();
+
+    resetCounts();
+
+    lastUpdateMs = juce::Time::getMillisecondCounterHiRes();
+    startTimerHz (updateRateHz);
+}
+
+MidiActivityPanel::~MidiActivityPanel()
+{
+    stopTimer();
+}
+
+const MidiActivityCounters::Direction& MidiActivityPanel::getCounters (int direction) const
+{
+    return direction == 0 ? counters.in : counters.out;
+}
+
+void MidiActivityPanel::resetCounts()
+{
+    for (int direction = 0; direction < numDirections; ++direction)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto& cell = cells[direction][channel];
+            cell.notesBaseline = getCounters (direction).channels[(size_t) channel].notes.load();
+            cell.notes = 0;
+        }
+    }
+
+    repaint();
+}
+
+//==============================================================================
+void MidiActivityPanel::timerCallback()
+{
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    const double elapsedSeconds = (nowMs - lastUpdateMs) * 0.001;
+    lastUpdateMs = nowMs;
+
+    if (elapsedSeconds <= 0.0)
+        return;
+
+    for (int direction = 0; direction < numDirections; ++direction)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto& source = getCounters (direction).channels[(size_t) channel];
+            auto& cell = cells[direction][channel];
+
+            const auto messages = source.messages.load (std::memory_order_relaxed);
+            const auto newMessages = messages - cell.messages;
+            cell.messages = messages;
+
+            cell.rate += rateSmoothing * (newMessages / elapsedSeconds - cell.rate);
+
+            const int level = newMessages > 0 ? maxLevel : (cell.level * 3 / 4 < 8 ? 0 : cell.level * 3 / 4);
+            const auto notes = source.notes.load (std::memory_order_relaxed) - cell.notesBaseline;
+            const int roundedRate = juce::roundToInt (cell.rate);
+
+            if (level != cell.level || notes != cell.notes || roundedRate != cell.roundedRate)
+            {
+                cell.level = level;
+                cell.notes = notes;
+                cell.roundedRate = roundedRate;
+                repaint (getCellBounds (direction, channel));
+            }
+        }
+    }
+}
+
+//==============================================================================
+juce::Rectangle<int> MidiActivityPanel::getCellBounds (int direction, int channel) const
+{
+    const int x = labelWidth + juce::roundToInt ((float) channel * cellWidth);
+    const int right = labelWidth + juce::roundToInt ((float) (channel + 1) * cellWidth);
+    const int y = headerHeight + juce::roundToInt ((float) direction * cellHeight);
+    const int bottom = headerHeight + juce::roundToInt ((float) (direction + 1) * cellHeight);
+
+    return { x, y, right - x, bottom - y };
+}
+
+void MidiActivityPanel::resized()
+{
+    labelWidth = 34;
+    headerHeight = 12;
+    cellWidth = (float) (getWidth() - labelWidth) / numChannels;
+    cellHeight = (float) (getHeight() - headerHeight) / numDirections;
+}
+
+void MidiActivityPanel::paint (juce::Graphics& g)
+{
+    const auto background = getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId);
+    const auto clip = g.getClipBounds();
+
+    g.fillAll (background);
+    g.setFont (10.0f);
+
+    // Header and row labels only when they are part of the repainted area
+    if (clip.getY() < headerHeight)
+    {
+        g.setColour (juce::Colours::grey);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto cell = getCellBounds (0, channel);
+            g.drawText (juce::String (channel + 1), cell.getX(), 0, cell.getWidth(), headerHeight,
+                        juce::Justification::centred, false);
+        }
+    }
+
+    if (clip.getX() < labelWidth)
+    {
+        for (int direction = 0; direction < numDirections; ++direction)
+        {
+            auto row = getCellBounds (direction, 0).withX (0).withWidth (labelWidth - 2);
+            g.setColour (juce::Colours::white);
+            g.drawText (direction == 0 ? "In" : "Out", row.removeFromTop (row.getHeight() / 3),
+                        juce::Justification::centredLeft, false);
+            g.setColour (juce::Colours::grey);
+            g.drawText ("notes", row.removeFromTop (row.getHeight() / 2), juce::Justification::centredLeft, false);
+            g.drawText ("msg/s", row, juce::Justification::centredLeft, false);
+        }
+    }
+
+    for (int direction = 0; direction < numDirections; ++direction)
+    {
+        const auto ledColour = direction == 0 ? juce::Colours::limegreen : juce::Colours::orange;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto bounds = getCellBounds (direction, channel);
+
+            if (! clip.intersects (bounds))
+                continue;
+
+            const auto& cell = cells[direction][channel];
+            bounds.reduce (1, 1);
+
+            auto led = bounds.removeFromTop (bounds.getHeight() / 3).reduced (2, 1);
+            g.setColour (background.darker (0.6f).interpolatedWith (ledColour, (float) cell.level / maxLevel));
+            g.fillRect (led);
+
+            g.setColour (cell.notes > 0 ? juce::Colours::white : juce::Colours::grey);
+            g.drawText (formatCount (cell.notes), bounds.removeFromTop (bounds.getHeight() / 2),
+                        juce::Justification::centred, false);
+
+            g.setColour (cell.roundedRate > 0 ? juce::Colours::white : juce::Colours::grey);
+            g.drawText (juce::String (cell.roundedRate), bounds, juce::Justification::centred, false);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    Per-channel in/out activity, note counts and message rates, read from
+    MidiActivityCounters. Only the cells whose display changed are repainted.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiActivityCounters.h"
+
+//==============================================================================
+/**
+*/
+class MidiActivityPanel  : public juce::Component,
+                           private juce::Timer
+{
+public:
+    explicit MidiActivityPanel (MidiActivityCounters& countersToShow);
+    ~MidiActivityPanel() override;
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+    // Note counts start from zero again
+    void resetCounts();
+
+private:
+    static constexpr int numChannels = MidiActivityCounters::numChannels;
+    static constexpr int numDirections = 2;   // 0 = in, 1 = out
+
+    struct Cell
+    {
+        juce::uint32 messages = 0;        // counter value at the last update
+        juce::uint32 notesBaseline = 0;   // counter value at the last reset
+        double rate = 0.0;                // smoothed messages per second
+
+        // What is currently on screen
+        int level = 0;
+        juce::uint32 notes = 0;
+        int roundedRate = 0;
+    };
+
+    void timerCallback() override;
+    juce::Rectangle<int> getCellBounds (int direction, int channel) const;
+    const MidiActivityCounters::Direction& getCounters (int direction) const;
+
+    MidiActivityCounters& counters;
+    Cell cells[numDirections][numChannels];
+    double lastUpdateMs = 0.0;
+
+    int labelWidth = 0, headerHeight = 0;
+    float cellWidth = 0.0f, cellHeight = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiActivityPanel)
+};
@@ -0,0 +1,435 @@
+/*
+  ==============================================================================
+
+    Follows an inbound MIDI clock and regenerates it sample-accurately.
+
+  ==============================================================================
+*/
+
+#include "MidiClockFollower.h"
+
+namespace
+{
+    // 300 BPM down to 20 BPM
+    constexpr double minPeriodMs = 60000.0 / (300.0 * MidiClockFollower::ticksPerQuarterNote);
+    constexpr double maxPeriodMs = 60000.0 / (20.0 * MidiClockFollower::ticksPerQuarterNote);
+
+    // Ticks averaged before the loop is seeded
+    constexpr int acquisitionTicks = 7;
+
+    // A clock that stays silent this long has stopped; the next tick re-acquires
+    constexpr double lockTimeoutMs = 500.0;
+
+    // Loop bandwidth: wide right after lock to pull in quickly, then narrow to reject jitter
+    constexpr double pullInBandwidthHz = 3.0;
+    constexpr double trackingBandwidthHz = 0.5;
+    constexpr juce::int64 pullInTicks = 2 * MidiClockFollower::ticksPerQuarterNote;
+
+    // How far the output may run ahead of the last received tick, to bridge lost packets
+    constexpr juce::int64 maxFreewheelTicks = 3;
+
+    // Loss is assumed when the gap to the previous arrival is at least this many periods
+    constexpr double lossGapPeriods = 1.75;
+
+    // Losses on this many arrivals in a row mean the tempo dropped; the loop re-acquires.
+    // Only a gap shorter than lossRunClearPeriods breaks the run, so one long gap
+    // shortened by jitter does not hide a tempo drop.
+    constexpr int maxLossesInRun = 3;
+    constexpr double lossRunClearPeriods = 1.5;
+
+    // A presumed loss that is not contradicted within this many ticks is kept
+    constexpr juce::int64 lossConfirmationTicks = 8;
+
+    // A loss hidden by jitter is caught once this many arrivals in a row are a period late
+    constexpr int hiddenLossTicks = 5;
+
+    // Errors beyond this fraction of a period, with the same sign this many times
+    // in a row, count as a tempo change
+    constexpr double tempoChangeError = 0.25;
+    constexpr int tempoChangeTicks = 8;
+
+    // Beyond this the output skips ahead instead of bursting out the missed ticks
+    constexpr juce::int64 maxOutputBacklog = MidiClockFollower::ticksPerQuarterNote;
+
+    constexpr double jitterSmoothing = 0.02;
+    constexpr double timebaseSlew = 0.01;
+}
+
+//==============================================================================
+MidiClockFollower::MidiClockFollower()
+{
+}
+
+void MidiClockFollower::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    blockTimeMs = -1.0;
+}
+
+void MidiClockFollower::reset()
+{
+    unlock();
+    numPendingTicks = 0;
+    outputTicksAhead = 0;
+    stopped = false;
+    lastArrivalMs = -1.0;
+    blockTimeMs = -1.0;
+    songPositionTicks = 0;
+    beatPhase = 0.0;
+}
+
+void MidiClockFollower::unlock()
+{
+    // The output count carries on through the raw ticks passed while unlocked:
+    // ticks it already ran ahead with are not passed again, and ticks that
+    // arrived but were not output yet are passed right away
+    if (locked)
+    {
+        outputTicksAhead = outputTicks - inputTicks;
+
+        for (; outputTicksAhead < 0; ++outputTicksAhead)
+            queuePassedTick (lastArrivalMs);
+    }
+
+    locked = false;
+    acquiredTicks = 0;
+    lossesInRun = 0;
+    lossRunTicks = 0;
+    unconfirmedLostTicks = 0;
+    ticksSinceLoss = 0;
+    numRecentArrivals = 0;
+    recentArrivalIndex = 0;
+    sameSignErrors = 0;
+    lastErrorSign = 0;
+    lastOutputMs = -1.0;
+    inputJitterSquared = 0.0;
+    outputJitterSquared = 0.0;
+
+    lockedState = false;
+    tempoBpm = 0.0;
+    publishJitter();
+}
+
+void MidiClockFollower::publishJitter()
+{
+    inputJitterMs = std::sqrt (inputJitterSquared);
+    outputJitterMs = std::sqrt (outputJitterSquared);
+}
+
+//==============================================================================
+void MidiClockFollower::handleClockTick (double arrivalMs)
+{
+    const double previousArrivalMs = lastArrivalMs;
+    lastArrivalMs = arrivalMs;
+    stopped = false;
+
+    if (previousArrivalMs >= 0.0 && arrivalMs - previousArrivalMs > lockTimeoutMs)
+        unlock();
+
+    if (! locked)
+    {
+        passTick (arrivalMs);
+
+        if (acquiredTicks > 0 && arrivalMs - previousArrivalMs > maxPeriodMs)
+            acquiredTicks = 0;
+
+        if (acquiredTicks++ == 0)
+        {
+            acquisitionStartMs = arrivalMs;
+            return;
+        }
+
+        if (acquiredTicks < acquisitionTicks)
+            return;
+
+        const double averageMs = (arrivalMs - acquisitionStartMs) / (acquisitionTicks - 1);
+
+        if (averageMs < minPeriodMs || averageMs > maxPeriodMs)
+        {
+            acquiredTicks = 0;
+            return;
+        }
+
+        locked = true;
+        periodMs = averageMs;
+        nextTickMs = arrivalMs + periodMs;
+        inputTicks = 0;
+        ticksSinceLock = 0;
+
+        // Everything up to this tick went out raw; the output continues from there
+        outputTicks = juce::jmax ((juce::int64) 0, outputTicksAhead);
+        outputTicksAhead = 0;
+
+        lockedState = true;
+        tempoBpm = 60000.0 / (periodMs * ticksPerQuarterNote);
+        return;
+    }
+
+    double error = arrivalMs - nextTickMs;
+
+    // Ticks are only taken as lost when nothing arrived for about two periods.
+    // A single late tick must not shift the count, so its phase error is not
+    // used to infer loss.
+    const double gapMs = arrivalMs - previousArrivalMs;
+
+    if (gapMs >= lossGapPeriods * periodMs)
+    {
+        // The same gap on every tick is a tempo drop, not a lossy link
+        if (++lossesInRun >= maxLossesInRun)
+        {
+            // The ticks counted as lost on the way were never sent
+            stepTickCount (-lossRunTicks);
+            unlock();
+            passTick (arrivalMs);
+            acquiredTicks = 1;
+            acquisitionStartMs = arrivalMs;
+            return;
+        }
+
+        if (unconfirmedLostTicks == 0)
+            firstLostTick = inputTicks;
+
+        const auto lostTicks = (juce::int64) std::floor (gapMs / periodMs + 0.5) - 1;
+        stepTickCount (lostTicks);
+        lossRunTicks += lostTicks;
+        unconfirmedLostTicks += lostTicks;
+        ticksSinceLoss = 0;
+    }
+    else
+    {
+        if (gapMs < lossRunClearPeriods * periodMs)
+        {
+            lossesInRun = 0;
+            lossRunTicks = 0;
+        }
+
+        // A very late tick looks like a loss. If a later one then arrives a
+        // period ahead of the earliest ticks before the gap, nothing was lost
+        // and the count is taken back.
+        if (unconfirmedLostTicks > 0)
+        {
+            const double earlyMs = getEarliestRecentArrivalMs (0, firstLostTick) - (arrivalMs - nextTickMs);
+
+            if (earlyMs > 0.5 * periodMs)
+            {
+                const auto recoveredTicks = juce::jmin (unconfirmedLostTicks, (juce::int64) std::floor (earlyMs / periodMs + 0.5));
+                stepTickCount (-recoveredTicks);
+                lossRunTicks -= recoveredTicks;
+                unconfirmedLostTicks -= recoveredTicks;
+
+                for (auto& r : recentArrivals)
+                    if (r.tick >= firstLostTick)
+                        r.tick -= recoveredTicks;
+            }
+        }
+
+        if (++ticksSinceLoss >= lossConfirmationTicks)
+            unconfirmedLostTicks = 0;
+    }
+
+    error = arrivalMs - nextTickMs;
+
+    // Until a presumed loss is confirmed, the loop follows whichever reading
+    // fits this arrival better, so a late tick taken for a loss does not pull
+    // the phase and tempo a period away. The count is left as it is.
+    if (unconfirmedLostTicks > 0)
+    {
+        const double errorIfNotLost = error + (double) unconfirmedLostTicks * periodMs;
+
+        if (std::abs (errorIfNotLost) < std::abs (error))
+            error = errorIfNotLost;
+    }
+
+    // A run of errors with the same sign means the tempo moved: widen the loop
+    // again so it pulls in quickly instead of slewing at the tracking bandwidth
+    const int errorSign = error > tempoChangeError * periodMs ? 1 : (error < -tempoChangeError * periodMs ? -1 : 0);
+    sameSignErrors = (errorSign != 0 && errorSign == lastErrorSign) ? sameSignErrors + 1 : 0;
+    lastErrorSign = errorSign;
+
+    if (sameSignErrors >= tempoChangeTicks)
+    {
+        ticksSinceLock = 0;
+        sameSignErrors = 0;
+    }
+
+    // Jitter only ever delays a tick, so once the loop is tracking, some of the
+    // last few arrivals are always close to it. If every one of them is a
+    // period late, a loss was hidden by jitter and slipped past the gap check.
+    auto& recent = recentArrivals[(size_t) recentArrivalIndex];
+    recent.arrivalMs = arrivalMs;
+    recent.tick = inputTicks;
+    recentArrivalIndex = (recentArrivalIndex + 1) % (int) recentArrivals.size();
+    numRecentArrivals = juce::jmin (numRecentArrivals + 1, (int) recentArrivals.size());
+
+    if (ticksSinceLock >= pullInTicks && numRecentArrivals >= hiddenLossTicks)
+    {
+        const double earliestMs = getEarliestRecentArrivalMs (inputTicks - hiddenLossTicks + 1, inputTicks + 1);
+
+        if (earliestMs > 0.5 * periodMs)
+        {
+            const auto hiddenTicks = (juce::int64) std::floor (earliestMs / periodMs + 0.5);
+            stepTickCount (hiddenTicks);
+            lossRunTicks += hiddenTicks;
+            error = arrivalMs - nextTickMs;
+
+            for (auto& r : recentArrivals)
+                r.tick += hiddenTicks;
+        }
+    }
+
+    error = juce::jlimit (-0.5 * periodMs, 0.5 * periodMs, error);
+
+    // Second-order DLL, coefficients from the loop bandwidth and the current update interval
+    const double bandwidthHz = ticksSinceLock < pullInTicks ? pullInBandwidthHz : trackingBandwidthHz;
+    const double omega = juce::MathConstants<double>::twoPi * bandwidthHz * periodMs * 0.001;
+
+    nextTickMs += periodMs + juce::MathConstants<double>::sqrt2 * omega * error;
+    periodMs = juce::jlimit (minPeriodMs, maxPeriodMs, periodMs + omega * omega * error);
+    ++inputTicks;
+    ++ticksSinceLock;
+
+    inputJitterSquared += jitterSmoothing * (error * error - inputJitterSquared);
+
+    tempoBpm = 60000.0 / (periodMs * ticksPerQuarterNote);
+    publishJitter();
+}
+
+double MidiClockFollower::getEarliestRecentArrivalMs (juce::int64 fromTick, juce::int64 toTick) const
+{
+    // Relative to where the loop puts each of those ticks now. Without any
+    // arrivals in the range, the loop phase itself is the reference.
+    double earliestMs = 0.0;
+    bool found = false;
+
+    for (int i = 0; i < numRecentArrivals; ++i)
+    {
+        const auto& r = recentArrivals[(size_t) i];
+
+        if (r.tick < fromTick || r.tick >= toTick)
+            continue;
+
+        const double residualMs = r.arrivalMs - (nextTickMs + (double) (r.tick - inputTicks) * periodMs);
+        earliestMs = found ? juce::jmin (earliestMs, residualMs) : residualMs;
+        found = true;
+    }
+
+    return earliestMs;
+}
+
+void MidiClockFollower::stepTickCount (juce::int64 ticks)
+{
+    // Moves which tick the next arrival stands for. The time of every output
+    // tick (nextTickMs + (n - inputTicks) * periodMs) stays where it was.
+    nextTickMs += (double) ticks * periodMs;
+    inputTicks += ticks;
+}
+
+void MidiClockFollower::passTick (double arrivalMs)
+{
+    if (outputTicksAhead > 0)
+        --outputTicksAhead;
+    else
+        queuePassedTick (arrivalMs);
+}
+
+void MidiClockFollower::queuePassedTick (double arrivalMs)
+{
+    // Past the capacity the last slot is reused, so at least the count stays right
+    pendingTickMs[(size_t) juce::jmin (numPendingTicks, (int) pendingTickMs.size() - 1)] = arrivalMs;
+    ++numPendingTicks;
+}
+
+void MidiClockFollower::handleStop()
+{
+    // No freewheeling past the last tick the 3DS sent
+    stopped = true;
+}
+
+void MidiClockFollower::handleStart()
+{
+    songPositionTicks = 0;
+    beatPhase = 0.0;
+}
+
+void MidiClockFollower::handleSongPosition (int midiBeats)
+{
+    // One MIDI beat is a sixteenth note
+    songPositionTicks = (juce::int64) midiBeats * (ticksPerQuarterNote / 4);
+}
+
+//==============================================================================
+void MidiClockFollower::renderBlock (juce::MidiBuffer& midiMessages, double nowMs, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    const double blockLengthMs = numSamples * 1000.0 / sampleRate;
+
+    // Count the timebase in samples and only slew it towards the wall clock, so
+    // the jitter of the audio callback itself does not end up in the output
+    if (blockTimeMs < 0.0 || std::abs (nowMs - blockTimeMs) > 2.0 * blockLengthMs + 20.0)
+        blockTimeMs = nowMs;
+    else
+        blockTimeMs += timebaseSlew * (nowMs - blockTimeMs);
+
+    const double blockEndMs = blockTimeMs + blockLengthMs;
+
+    if (locked && blockTimeMs - lastArrivalMs > lockTimeoutMs)
+        unlock();
+
+    // Raw ticks from while the loop was not locked, one block late so that
+    // their spacing is kept
+    for (int i = 0; i < numPendingTicks; ++i)
+    {
+        const double tickMs = pendingTickMs[(size_t) juce::jmin (i, (int) pendingTickMs.size() - 1)] + blockLengthMs;
+        const int offset = juce::jlimit (0, numSamples - 1,
+                                         (int) std::floor ((tickMs - blockTimeMs) * sampleRate * 0.001));
+        midiMessages.addEvent (juce::MidiMessage::midiClock(), offset);
+        ++songPositionTicks;
+    }
+
+    numPendingTicks = 0;
+
+    if (locked)
+    {
+        if (inputTicks - outputTicks > maxOutputBacklog)
+            outputTicks = inputTicks;
+
+        const auto lastOutputTick = stopped ? inputTicks - 1 : inputTicks + maxFreewheelTicks;
+
+        while (outputTicks <= lastOutputTick)
+        {
+            const double tickMs = nextTickMs + (double) (outputTicks - inputTicks) * periodMs;
+
+            if (tickMs >= blockEndMs)
+                break;
+
+            const int offset = juce::jlimit (0, numSamples - 1,
+                                             (int) std::floor ((tickMs - blockTimeMs) * sampleRate * 0.001));
+            midiMessages.addEvent (juce::MidiMessage::midiClock(), offset);
+
+            const double emittedMs = blockTimeMs + offset * 1000.0 / sampleRate;
+
+            if (lastOutputMs >= 0.0)
+            {
+                const double deviation = (emittedMs - lastOutputMs) - periodMs;
+                outputJitterSquared += jitterSmoothing * (deviation * deviation - outputJitterSquared);
+            }
+
+            lastOutputMs = emittedMs;
+            ++outputTicks;
+            ++songPositionTicks;
+        }
+
+        if (songPositionTicks > 0 && lastOutputMs >= 0.0)
+        {
+            const double fraction = juce::jlimit (0.0, 1.0, (blockEndMs - lastOutputMs) / periodMs);
+            const double beats = ((double) (songPositionTicks - 1) + fraction) / ticksPerQuarterNote;
+            beatPhase = beats - std::floor (beats);
+        }
+
+        publishJitter();
+    }
+
+    blockTimeMs += blockLengthMs;
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    Follows an inbound MIDI clock (0xF8) that arrives with network jitter and
+    regenerates it as a smoothed, sample-accurate clock.
+
+    Arrival times are fed through a second-order delay-locked loop, which
+    estimates the tick period (tempo) and the time of the next tick (phase).
+    The output clock is scheduled from that estimate rather than from the raw
+    arrivals, and freewheels over a few lost packets. Until the loop locks,
+    the raw ticks are passed through, so the output never drops a tick the
+    3DS sent.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/**
+*/
+class MidiClockFollower
+{
+public:
+    static constexpr int ticksPerQuarterNote = 24;
+
+    MidiClockFollower();
+
+    //==============================================================================
+    // Audio thread only
+    void prepare (double sampleRate);
+    void reset();
+
+    void handleClockTick (double arrivalMs);
+    void handleStart();
+    void handleStop();
+    void handleSongPosition (int midiBeats);
+
+    // Adds the smoothed clock ticks that fall inside this block to the buffer.
+    void renderBlock (juce::MidiBuffer& midiMessages, double nowMs, int numSamples);
+
+    //==============================================================================
+    // Safe to call from any thread
+    bool isLocked() const noexcept              { return lockedState.load(); }
+    double getTempoBpm() const noexcept         { return tempoBpm.load(); }
+    double getBeatPhase() const noexcept        { return beatPhase.load(); }
+    double getInputJitterMs() const noexcept    { return inputJitterMs.load(); }
+    double getOutputJitterMs() const noexcept   { return outputJitterMs.load(); }
+
+private:
+    void unlock();
+    double getEarliestRecentArrivalMs (juce::int64 fromTick, juce::int64 toTick) const;
+    void stepTickCount (juce::int64 ticks);
+    void passTick (double arrivalMs);
+    void queuePassedTick (double arrivalMs);
+    void publishJitter();
+
+    double sampleRate = 44100.0;
+
+    // Acquisition: the first few intervals are averaged to seed the loop
+    int acquiredTicks = 0;
+    double acquisitionStartMs = 0.0;
+    double lastArrivalMs = -1.0;
+
+    // Loop state
+    bool locked = false;
+    double nextTickMs = 0.0;    // predicted arrival of tick number inputTicks
+    double periodMs = 0.0;      // smoothed tick period
+    juce::int64 inputTicks = 0;
+    juce::int64 ticksSinceLock = 0;
+
+    // Loss bookkeeping: a presumed loss stays unconfirmed for a few ticks so a
+    // very late tick that was taken for one can be taken back
+    int lossesInRun = 0;
+    juce::int64 lossRunTicks = 0;
+    juce::int64 unconfirmedLostTicks = 0;
+    juce::int64 ticksSinceLoss = 0;
+    juce::int64 firstLostTick = 0;
+
+    struct RecentArrival
+    {
+        double arrivalMs = 0.0;
+        juce::int64 tick = 0;
+    };
+
+    std::array<RecentArrival, 8> recentArrivals;
+    int numRecentArrivals = 0;
+    int recentArrivalIndex = 0;
+
+    int sameSignErrors = 0;
+    int lastErrorSign = 0;
+
+    // Output schedule
+    juce::int64 outputTicks = 0;
+    bool stopped = false;
+
+    // Raw ticks passed through while unlocked, output by the next renderBlock()
+    std::array<double, 32> pendingTickMs;
+    int numPendingTicks = 0;
+    juce::int64 outputTicksAhead = 0;   // ticks output before they arrived, as of the last unlock
+    juce::int64 songPositionTicks = 0;
+    double blockTimeMs = -1.0;
+    double lastOutputMs = -1.0;
+
+    double inputJitterSquared = 0.0;
+    double outputJitterSquared = 0.0;
+
+    std::atomic<bool> lockedState { false };
+    std::atomic<double> tempoBpm { 0.0 };
+    std::atomic<double> beatPhase { 0.0 };
+    std::atomic<double> inputJitterMs { 0.0 };
+    std::atomic<double> outputJitterMs { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiClockFollower)
+};
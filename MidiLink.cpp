@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    The UDP MIDI link to the 3DS.
+
+  ==============================================================================
+*/
+
+#include "MidiLink.h"
+
+//==============================================================================
+MidiLink::MidiLink()
+{
+    udpSocket.bindToPort(sendPort); // Optional: bind to an ephemeral port
+    udpSocket.setEnablePortReuse(true); // Optional
+
+    udpReceiver = std::make_unique<juce::DatagramSocket>(/* enableBroadcasting = */ false);
+
+    // Now bind to a specific port
+    if (!udpReceiver->bindToPort(listenPort))
+    {
+        DBG("Failed to bind UDP socket to port " << listenPort);
+    }
+
+    clockSync = std::make_unique<ClockSync>();
+
+    udpMidiReceiver = std::make_unique<UdpMidiReceiver>(*udpReceiver);
+    udpMidiReceiver->packetFilter = [this](const juce::uint8* data, int size, double arrivalMs)
+    {
+        return clockSync->handlePacket(data, size, arrivalMs);
+    };
+    udpMidiReceiver->start();
+
+    clockSync->start();
+}
+
+MidiLink::~MidiLink()
+{
+    // Stop reading before the socket goes away
+    udpMidiReceiver = nullptr;
+    clockSync = nullptr;
+
+    if (udpReceiver != nullptr)
+    {
+        udpReceiver->shutdown();  // optional, depending on your usage
+        udpReceiver = nullptr;    // cleanup
+    }
+}
+
+void MidiLink::setTarget(const juce::String& ipAddress)
+{
+    targetIP = ipAddress;
+    clockSync->setTarget(ipAddress, sendPort);
+}
+
+void MidiLink::prepare(double sampleRate)
+{
+    clockFollower.prepare(sampleRate);
+    clockFollower.reset();
+}
+
+//==============================================================================
+void MidiLink::sendMessage(const juce::MidiMessage& message)
+{
+    const void* data = static_cast<const void*>(message.getRawData());
+    int size = message.getRawDataSize();
+
+    // Only send if it's a real MIDI message (optional: filter SysEx, etc.)
+    if (size > 0)
+    {
+        udpSocket.write(targetIP, sendPort, data, size);
+        ++messagesSent;
+        bytesSent += (juce::uint64) size;
+    }
+}
+
+void MidiLink::receiveMessages(juce::MidiBuffer& midiMessages, int numSamples)
+{
+    // Drain everything the receiver thread has stamped since the last block
+    const double blockStartMs = juce::Time::getMillisecondCounterHiRes();
+
+    UdpMidiReceiver::Packet packet;
+
+    while (udpMidiReceiver->popPacket(packet))
+    {
+        inboundLatency.add(blockStartMs - packet.arrivalMs);
+        handleIncomingPacket(packet, midiMessages);
+    }
+
+    // Smoothed clock from the 3DS, placed at its sample position within this block
+    clockFollower.renderBlock(midiMessages, blockStartMs, numSamples);
+}
+
+void MidiLink::handleIncomingPacket(const UdpMidiReceiver::Packet& packet, juce::MidiBuffer& midiMessages)
+{
+    if (packet.size < 1 || (packet.data[0] & 0x80) == 0)  // status byte in MSB
+        return;
+
+    ++messagesReceived;
+    bytesReceived += (juce::uint64) packet.size;
+
+    // Realtime bytes are single-byte messages; the raw clock never goes to the
+    // buffer, the follower regenerates it in renderBlock()
+    if (packet.data[0] >= 0xf8)
+    {
+        const juce::MidiMessage msg(packet.data, 1, packet.arrivalMs);
+
+        if (msg.isMidiClock())
+        {
+            clockFollower.handleClockTick(packet.arrivalMs);
+        }
+        else if (msg.isMidiStart() || msg.isMidiContinue() || msg.isMidiStop())
+        {
+            if (msg.isMidiStart())
+                clockFollower.handleStart();
+            else if (msg.isMidiStop())
+                clockFollower.handleStop();
+
+            if (logMessage != nullptr && loggingEnabled.load())
+                logMessage("In: " + msg.getDescription());
+
+            midiMessages.addEvent(msg, 0);
+        }
+
+        return;
+    }
+
+    if (packet.size >= 3)
+    {
+        juce::MidiMessage msg(packet.data, packet.size, packet.arrivalMs);
+
+        if (logMessage != nullptr && loggingEnabled.load())
+            logMessage("In: " + msg.getDescription());
+
+        if (msg.isSongPositionPointer())
+        {
+            clockFollower.handleSongPosition(msg.getSongPositionPointerMidiBeat());
+            midiMessages.addEvent(msg, 0);
+        }
+        else if (msg.isNoteOn() || msg.isNoteOff() || msg.isController() || msg.isSysEx())
+        {
+            midiMessages.addEvent(msg, 0);
+        }
+    }
+}
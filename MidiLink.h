@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    The UDP MIDI link to the 3DS: sockets, the inbound receiver thread, clock
+    following and clock sync. Shared by the plugin processor and the headless
+    bridge so both speak to the 3DS the same way.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include "ClockSync.h"
+#include "MidiClockFollower.h"
+#include "UdpMidiReceiver.h"
+
+//==============================================================================
+/**
+*/
+class MidiLink
+{
+public:
+    static constexpr int sendPort = 9001;     // Default DSMIDI UDP port
+    static constexpr int listenPort = 9000;   // The port the 3DS sends to
+
+    MidiLink();
+    ~MidiLink();
+
+    void setTarget (const juce::String& ipAddress);
+    const juce::String& getTargetIP() const noexcept { return targetIP; }
+
+    void prepare (double sampleRate);
+
+    // Sends one message to the 3DS
+    void sendMessage (const juce::MidiMessage& message);
+
+    // Adds everything received from the 3DS since the last call to the buffer,
+    // plus the smoothed clock for a block of numSamples
+    void receiveMessages (juce::MidiBuffer& midiMessages, int numSamples);
+
+    // Time from UDP arrival to being handed out by receiveMessages(), since the last call
+    struct LatencyStats
+    {
+        int count = 0;
+        double averageMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+    // Latencies added on one thread and taken on another. Both hold a spin lock,
+    // so each sample lands wholly in one interval and count, average and max
+    // always describe the same samples.
+    class LatencyMeter
+    {
+    public:
+        void add (double latencyMs) noexcept
+        {
+            const juce::SpinLock::ScopedLockType sl (lock);
+            ++count;
+            sumMs += latencyMs;
+            maxMs = juce::jmax (maxMs, latencyMs);
+        }
+
+        LatencyStats take() noexcept
+        {
+            LatencyStats stats;
+            double sum;
+
+            {
+                const juce::SpinLock::ScopedLockType sl (lock);
+                stats.count = count;
+                stats.maxMs = maxMs;
+                sum = sumMs;
+                count = 0;
+                sumMs = maxMs = 0.0;
+            }
+
+            if (stats.count > 0)
+                stats.averageMs = sum / stats.count;
+
+            return stats;
+        }
+
+    private:
+        juce::SpinLock lock;
+        int count = 0;
+        double sumMs = 0.0, maxMs = 0.0;
+    };
+
+    LatencyStats takeInboundLatencyStats() { return inboundLatency.take(); }
+
+    // Called for every inbound message if set and enabled, e.g. to feed a log
+    std::function<void (const juce::String&)> logMessage;
+    std::atomic<bool> loggingEnabled { true };
+
+    // Smooths the clock the 3DS sends when it is the clock master
+    MidiClockFollower clockFollower;
+
+    // Continuously updated mapping between host time and the 3DS clock
+    std::unique_ptr<ClockSync> clockSync;
+
+    std::atomic<juce::uint64> messagesSent { 0 }, bytesSent { 0 };
+    std::atomic<juce::uint64> messagesReceived { 0 }, bytesReceived { 0 };
+
+    int getNumDroppedPackets() const noexcept { return udpMidiReceiver->getNumDroppedPackets(); }
+
+private:
+    void handleIncomingPacket (const UdpMidiReceiver::Packet& packet, juce::MidiBuffer& midiMessages);
+
+    juce::DatagramSocket udpSocket;
+    std::unique_ptr<juce::DatagramSocket> udpReceiver;
+    std::unique_ptr<UdpMidiReceiver> udpMidiReceiver;
+
+    juce::String targetIP = "192.168.2.101";
+
+    LatencyMeter inboundLatency;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiLink)
+};
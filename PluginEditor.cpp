@@ -50,11 +50,11 @@ juce::StringArray getUsableIPAddresses()
 
 //==============================================================================
 NcMidiAudioProcessorEditor::NcMidiAudioProcessorEditor (NcMidiAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), activityPanel (p.midiActivity), audioProcessor (p)
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 400);
+    setSize (400, 480);
 
     midiLog.setMultiLine(true);
     midiLog.setReadOnly(true);
@@ -70,6 +70,7 @@ NcMidiAudioProcessorEditor::NcMidiAudioProcessorEditor (NcMidiAudioProcessor& p)
     clearButton.onClick = [this]()
     {
         midiLog.clear();
+        activityPanel.resetCounts();
     };
 
     // Add Max Lines slider
@@ -89,11 +90,35 @@ NcMidiAudioProcessorEditor::NcMidiAudioProcessorEditor (NcMidiAudioProcessor& p)
     enableLoggingToggle.onClick = [this]()
     {
         loggingEnabled = enableLoggingToggle.getToggleState();
+        audioProcessor.setLoggingEnabled(loggingEnabled);
         juce::PropertiesFile* props = audioProcessor.appProperties.getUserSettings();
         props->setValue("logging_enabled", loggingEnabled);
         props->saveIfNeeded();
     };
 
+    addAndMakeVisible(activityPanel);
+
+    clockLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(clockLabel);
+    updateClockLabel();
+
+    syncLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(syncLabel);
+    updateSyncLabel();
+
+    // Off by default: a 3DS build that does not answer sync requests would read them as MIDI
+    addAndMakeVisible(clockSyncToggle);
+    clockSyncToggle.setToggleState(audioProcessor.midiLink.clockSync->isEnabled(), juce::dontSendNotification);
+    clockSyncToggle.onClick = [this]()
+    {
+        const bool syncEnabled = clockSyncToggle.getToggleState();
+        audioProcessor.midiLink.clockSync->setEnabled(syncEnabled);
+        juce::PropertiesFile* props = audioProcessor.appProperties.getUserSettings();
+        props->setValue("clock_sync_enabled", syncEnabled);
+        props->saveIfNeeded();
+        updateSyncLabel();
+    };
+
     startTimerHz(20); // 20 times per second
 }
 
@@ -116,6 +141,11 @@ void NcMidiAudioProcessorEditor::resized()
     auto area = getLocalBounds();
     auto topArea = area.removeFromTop(30);
     auto botArea = area.removeFromBottom(60);
+    auto syncRow = area.removeFromBottom(20);
+    clockSyncToggle.setBounds(syncRow.removeFromRight(100));
+    syncLabel.setBounds(syncRow);
+    clockLabel.setBounds(area.removeFromBottom(20));
+    activityPanel.setBounds(area.removeFromBottom(80));
 
     selfIpSelector.setBounds(topArea.removeFromLeft(topArea.getWidth()/2));
     dsIpSelector.setBounds(topArea);
@@ -239,8 +269,53 @@ void NcMidiAudioProcessorEditor::parentHierarchyChanged()
     }
 }
 
+void NcMidiAudioProcessorEditor::updateClockLabel()
+{
+    const auto& follower = audioProcessor.midiLink.clockFollower;
+
+    if (!follower.isLocked())
+    {
+        clockLabel.setText("Clock: not locked", juce::dontSendNotification);
+        return;
+    }
+
+    clockLabel.setText("Clock: " + juce::String(follower.getTempoBpm(), 1) + " BPM"
+                       + "  beat " + juce::String(follower.getBeatPhase(), 2)
+                       + "  jitter in " + juce::String(follower.getInputJitterMs(), 2) + " ms"
+                       + " / out " + juce::String(follower.getOutputJitterMs(), 2) + " ms",
+                       juce::dontSendNotification);
+}
+
+void NcMidiAudioProcessorEditor::updateSyncLabel()
+{
+    if (!audioProcessor.midiLink.clockSync->isEnabled())
+    {
+        syncLabel.setText("3DS clock: sync off", juce::dontSendNotification);
+        return;
+    }
+
+    const auto mapping = audioProcessor.midiLink.clockSync->getMapping();
+
+    if (!mapping.valid)
+    {
+        syncLabel.setText("3DS clock: no sync replies", juce::dontSendNotification);
+        return;
+    }
+
+    syncLabel.setText("3DS clock: offset " + juce::String(mapping.offsetMs, 2) + " ms"
+                      + "  drift " + juce::String(mapping.driftPpm, 1) + " ppm"
+                      + "  rtt " + juce::String(mapping.roundTripMs, 2) + " ms",
+                      juce::dontSendNotification);
+}
+
 void NcMidiAudioProcessorEditor::timerCallback()
 {
+    if (isShowing())
+    {
+        updateClockLabel();
+        updateSyncLabel();
+    }
+
     if (!loggingEnabled || !isShowing())
         return;
 
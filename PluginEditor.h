@@ -9,6 +9,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "MidiActivityPanel.h"
 #include "PluginProcessor.h"
 
 //==============================================================================
@@ -44,6 +45,15 @@ public:
     juce::TextEditor dsIpSelector;
     juce::Label ipLabel;
 
+    MidiActivityPanel activityPanel;
+
+    juce::Label clockLabel;
+    void updateClockLabel();
+
+    juce::Label syncLabel;
+    juce::ToggleButton clockSyncToggle { "Clock Sync" };
+    void updateSyncLabel();
+
     juce::TextButton discoverButton;
     void startDiscovery();
     bool isDiscovering = false;
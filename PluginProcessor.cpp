@@ -16,17 +16,7 @@ NcMidiAudioProcessor::NcMidiAudioProcessor()
      : AudioProcessor (BusesProperties() )
 #endif
 {
-    udpSocket.bindToPort(9001); // Optional: bind to an ephemeral port
-    udpSocket.setEnablePortReuse(true); // Optional
-
-    const int listenPort = 9000; // or whatever port your 3DS sends to
-    udpReceiver = std::make_unique<juce::DatagramSocket>(/* enableBroadcasting = */ false);
-
-    // Now bind to a specific port
-    if (!udpReceiver->bindToPort(listenPort))
-    {
-        DBG("Failed to bind UDP socket to port " << listenPort);
-    }
+    midiLink.logMessage = [this](const juce::String& msg) { pushMidiMessage(msg); };
 
     juce::PropertiesFile::Options options;
     options.applicationName     = "NoiseCommander3DS_VST3";
@@ -38,15 +28,12 @@ NcMidiAudioProcessor::NcMidiAudioProcessor()
     juce::String dsIpAddress = props->getValue("3ds_ip", "192.168.1.0");
     //DBG("Using 3DS IP-Address " + dsIpAddress);
     set3DSIPAddress(dsIpAddress);
+    setLoggingEnabled(props->getBoolValue("logging_enabled", true));
+    midiLink.clockSync->setEnabled(props->getBoolValue("clock_sync_enabled", false));
 }
 
 NcMidiAudioProcessor::~NcMidiAudioProcessor()
 {
-    if (udpReceiver != nullptr)
-    {
-        udpReceiver->shutdown();  // optional, depending on your usage
-        udpReceiver = nullptr;    // cleanup
-    }
 }
 
 //==============================================================================
@@ -104,6 +91,9 @@ void NcMidiAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    juce::ignoreUnused (samplesPerBlock);
+    midiLink.prepare (sampleRate);
+    incomingMidi.ensureSize (4096);
 }
 
 void NcMidiAudioProcessor::releaseResources()
@@ -147,51 +137,28 @@ void NcMidiAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce:
 //     DBG("test msg");
 
     // Midi Out -> UDP
-    const int targetPort = 9001;
+    const bool logging = loggingEnabled.load();
 
     for (const auto metadata : midiMessages)
     {
+        midiActivity.out.count(metadata.data, metadata.numBytes);
+
         const juce::MidiMessage& msg = metadata.getMessage();
-        pushMidiMessage("Out: " + msg.getDescription());
-        const void* data = static_cast<const void*>(msg.getRawData());
-        int size = msg.getRawDataSize();
 
-        // Only send if it's a real MIDI message (optional: filter SysEx, etc.)
-        if (size > 0)
-        {
-//            DBG("Sending msg");
-            udpSocket.write(targetIP, targetPort, data, size);
-        }
+        if (logging)
+            pushMidiMessage("Out: " + msg.getDescription());
+
+        midiLink.sendMessage(msg);
     }
 
     // UDP -> Midi in
-    // Poll UDP socket for data:
-    if (udpReceiver && udpReceiver->waitUntilReady(true, 0))  // true = read ready, 0 = no wait
-    {
-        char udpBuffer[1024];
-        int bytesRead = udpReceiver->read(udpBuffer, sizeof(udpBuffer), false);
-//        DBG("In: " << (int)udpBuffer[0]
-//                << " " << (int)udpBuffer[1]
-//                << " " << (int)udpBuffer[2]);
-
-//        DBG("Bytes read: " << bytesRead);
-
-        if (bytesRead >= 3 && (udpBuffer[0] & 0x80))  // status byte in MSB
-        {
-            juce::MidiMessage msg(udpBuffer, bytesRead, juce::Time::getMillisecondCounterHiRes());
-//            pushMidiMessage(msg);  // To be shown in GUI
-            pushMidiMessage("In: " + msg.getDescription());
-//            DBG("Pushing ...");
-//            DBG(msg.getDescription());
-
-            if (msg.isNoteOn() || msg.isNoteOff() || msg.isController() || msg.isSysEx())
-            {
-                midiMessages.addEvent(msg, 0);
-            }
-        }
-    }
+    incomingMidi.clear();
+    midiLink.receiveMessages(incomingMidi, buffer.getNumSamples());
 
+    for (const auto metadata : incomingMidi)
+        midiActivity.in.count(metadata.data, metadata.numBytes);
 
+    midiMessages.addEvents(incomingMidi, 0, -1, 0);
 
     return;
 
@@ -312,9 +279,15 @@ std::deque<juce::String> NcMidiAudioProcessor::popMidiMessages()
     return messages;
 }
 
+void NcMidiAudioProcessor::setLoggingEnabled(bool shouldLog)
+{
+    loggingEnabled = shouldLog;
+    midiLink.loggingEnabled = shouldLog;
+}
+
 void NcMidiAudioProcessor::set3DSIPAddress(const juce::String &value)
 {
-    targetIP = value;
+    midiLink.setTarget(value);
 }
 
 //==============================================================================
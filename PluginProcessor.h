@@ -11,6 +11,8 @@
 #include <JuceHeader.h>
 #include <deque>
 #include <mutex>
+#include "MidiActivityCounters.h"
+#include "MidiLink.h"
 
 //==============================================================================
 /**
@@ -55,14 +57,17 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    juce::DatagramSocket udpSocket;
-    juce::String targetIP = "192.168.2.101";
-    int targetPort = 9001; // Default DSMIDI UDP port
-
-    // In your plugin processor header
-    std::unique_ptr<juce::DatagramSocket> udpReceiver;
+    // UDP link to the 3DS, shared with the headless bridge
+    MidiLink midiLink;
     juce::Array<juce::MidiMessage> incomingMidiFrom3DS;
 
+    // Incremented by processBlock, read by the editor's activity panel
+    MidiActivityCounters midiActivity;
+
+    // Off skips all log string formatting on the audio thread
+    void setLoggingEnabled(bool shouldLog);
+    std::atomic<bool> loggingEnabled { true };
+
     double previousPpq = 0;
     double ppqTicksAccumulated = 0.0;
     bool wasPlaying = false;
@@ -83,6 +88,8 @@ public:
      juce::ApplicationProperties appProperties;
 
 private:
+    juce::MidiBuffer incomingMidi;
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NcMidiAudioProcessor)
 };
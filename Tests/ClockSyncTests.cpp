@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    Drives ClockSync with a simulated 3DS: a clock with a fixed offset and
+    skew, answering requests over a link with exponential jitter in both
+    directions, all from a fixed seed.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../ClockSync.h"
+
+//==============================================================================
+class ClockSyncTests  : public juce::UnitTest
+{
+public:
+    ClockSyncTests()
+        : juce::UnitTest ("ClockSync", "NoiseCommander3DS")
+    {
+    }
+
+    void runTest() override
+    {
+        for (auto jitterMs : { 5.0, 20.0 })
+        {
+            for (auto skewPpm : { 80.0, -250.0 })
+            {
+                beginTest (juce::String (skewPpm) + " ppm skew, " + juce::String (jitterMs) + " ms mean jitter each way");
+
+                Scenario scenario;
+                scenario.skewPpm = skewPpm;
+                scenario.meanJitterMs = jitterMs;
+                const auto result = run (scenario);
+
+                // The min-RTT filter keeps the fastest exchanges, so the error
+                // grows far slower than the jitter itself. The drift over a 32 s
+                // window is only a rough estimate at this much jitter.
+                expectLessThan (result.meanErrorMs, 0.15 * jitterMs);
+                expectLessThan (result.maxErrorMs, 0.4 * jitterMs);
+                expectWithinAbsoluteError (result.driftPpm, skewPpm, 12.0 * jitterMs);
+            }
+        }
+
+        beginTest ("Replies from before a reset or a target change are ignored");
+        {
+            double nowMs = 1000.0;
+
+            ClockSync sync;
+            sync.hostClock = [&nowMs] { return nowMs; };
+            sync.setTarget ("192.168.2.101", 9001);
+
+            juce::uint8 request[ClockSync::packetSize], reply[ClockSync::packetSize];
+
+            expect (sync.makeRequest (request));
+            makeReply (request, nowMs + 5.0, nowMs + 5.0, reply);
+            sync.setTarget ("192.168.2.102", 9001);
+
+            expect (sync.handlePacket (reply, ClockSync::packetSize, nowMs + 10.0));
+            expect (! sync.getMapping().valid);
+
+            nowMs += 250.0;
+            expect (sync.makeRequest (request));
+            makeReply (request, nowMs + 5.0, nowMs + 5.0, reply);
+            sync.reset();
+
+            sync.handlePacket (reply, ClockSync::packetSize, nowMs + 10.0);
+            expect (! sync.getMapping().valid);
+
+            // A sequence number that was never sent
+            reply[8] = (juce::uint8) (reply[8] + 100);
+            sync.handlePacket (reply, ClockSync::packetSize, nowMs + 10.0);
+            expect (! sync.getMapping().valid);
+
+            nowMs += 250.0;
+            expect (sync.makeRequest (request));
+            makeReply (request, nowMs + 5.0, nowMs + 5.0, reply);
+
+            sync.handlePacket (reply, ClockSync::packetSize, nowMs + 10.0);
+            expect (sync.getMapping().valid);
+            expectWithinAbsoluteError (sync.getMapping().offsetMs, 0.0, 0.01);
+        }
+    }
+
+private:
+    struct Scenario
+    {
+        double remoteOffsetMs = 123456.0;
+        double skewPpm = 0.0;
+        double minDelayMs = 1.0;        // each way
+        double meanJitterMs = 0.0;      // exponential, each way
+        double requestIntervalMs = 250.0;
+        double durationMs = 120000.0;
+        double settleMs = 40000.0;      // a full window of samples
+    };
+
+    struct Result
+    {
+        double meanErrorMs = 0.0, maxErrorMs = 0.0;   // of hostToRemoteMs() after settling
+        double driftPpm = 0.0;
+    };
+
+    static void writeInt64 (juce::uint8* dest, juce::int64 value)
+    {
+        const auto le = juce::ByteOrder::swapIfBigEndian ((juce::uint64) value);
+        std::memcpy (dest, &le, sizeof (le));
+    }
+
+    // What the 3DS sends back: the request with its receive and send times
+    static void makeReply (const juce::uint8* request, double t2Ms, double t3Ms, juce::uint8* reply)
+    {
+        std::memcpy (reply, request, ClockSync::packetSize);
+        reply[4] = 2;
+        writeInt64 (reply + 20, (juce::int64) std::llround (t2Ms * 1000.0));
+        writeInt64 (reply + 28, (juce::int64) std::llround (t3Ms * 1000.0));
+    }
+
+    static Result run (const Scenario& scenario)
+    {
+        constexpr double startMs = 1000.0;
+        constexpr double turnaroundMs = 0.2;
+
+        juce::Random random (0x5c);
+
+        auto remoteTime = [&scenario] (double hostMs)
+        {
+            return scenario.remoteOffsetMs + hostMs * (1.0 + scenario.skewPpm * 1.0e-6);
+        };
+
+        auto delay = [&]
+        {
+            return scenario.minDelayMs - scenario.meanJitterMs * std::log (1.0 - random.nextDouble());
+        };
+
+        double nowMs = startMs;
+
+        ClockSync sync;
+        sync.hostClock = [&nowMs] { return nowMs; };
+        sync.setTarget ("192.168.2.101", 9001);
+
+        Result result;
+        double errorSumMs = 0.0;
+        int numErrors = 0;
+
+        juce::uint8 request[ClockSync::packetSize], reply[ClockSync::packetSize];
+
+        for (; nowMs < startMs + scenario.durationMs; nowMs += scenario.requestIntervalMs)
+        {
+            if (! sync.makeRequest (request))
+                break;
+
+            const double receivedMs = nowMs + delay();
+            const double sentMs = receivedMs + turnaroundMs;
+            makeReply (request, remoteTime (receivedMs), remoteTime (sentMs), reply);
+            sync.handlePacket (reply, ClockSync::packetSize, sentMs + delay());
+
+            const auto mapping = sync.getMapping();
+
+            if (nowMs - startMs >= scenario.settleMs && mapping.valid)
+            {
+                const double errorMs = std::abs (mapping.hostToRemoteMs (nowMs) - remoteTime (nowMs));
+                errorSumMs += errorMs;
+                result.maxErrorMs = juce::jmax (result.maxErrorMs, errorMs);
+                ++numErrors;
+            }
+        }
+
+        result.meanErrorMs = numErrors > 0 ? errorSumMs / numErrors : 1.0e9;
+        result.driftPpm = sync.getMapping().driftPpm;
+        return result;
+    }
+};
+
+static ClockSyncTests clockSyncTests;
@@ -0,0 +1,290 @@
+/*
+  ==============================================================================
+
+    Drives MidiClockFollower with a synthetic clock: exponential network
+    jitter, packet loss and tempo steps, all from a fixed seed.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+#include "../MidiClockFollower.h"
+
+//==============================================================================
+class MidiClockFollowerTests  : public juce::UnitTest
+{
+public:
+    MidiClockFollowerTests()
+        : juce::UnitTest ("MidiClockFollower", "NoiseCommander3DS")
+    {
+    }
+
+    void runTest() override
+    {
+        // Mean jitter up to about a third of the tick period. Beyond that, late
+        // ticks start to look like lost ones and the count can slip.
+        for (auto jitterMs : { 2.0, 4.0, 6.0 })
+        {
+            beginTest ("Steady 120 BPM, " + juce::String (jitterMs) + " ms mean jitter");
+
+            Scenario scenario;
+            scenario.meanJitterMs = jitterMs;
+            const auto result = run (scenario);
+
+            expectWithinAbsoluteError (result.tempoBpm, 120.0, 1.0);
+            expectEquals (result.countDrift, 0);
+            expectLessThan (result.outputJitterMs, result.inputJitterMs);
+        }
+
+        {
+            beginTest ("2% lost packets, 2 ms mean jitter");
+
+            Scenario scenario;
+            scenario.meanJitterMs = 2.0;
+            scenario.lossProbability = 0.02;
+            const auto result = run (scenario);
+
+            expectWithinAbsoluteError (result.tempoBpm, 120.0, 1.0);
+            expectEquals (result.countDrift, 0);
+        }
+
+        for (auto step : { std::make_pair (120.0, 180.0), std::make_pair (180.0, 120.0), std::make_pair (120.0, 90.0) })
+        {
+            beginTest ("Tempo step " + juce::String (step.first) + " -> " + juce::String (step.second) + " BPM");
+
+            Scenario scenario;
+            scenario.bpm = step.first;
+            scenario.stepToBpm = step.second;
+            scenario.meanJitterMs = 4.0;
+            const auto result = run (scenario);
+
+            expectWithinAbsoluteError (result.tempoBpmAfterStep, step.second, 0.01 * step.second);
+            expectWithinAbsoluteError (result.tempoBpm, step.second, 0.005 * step.second);
+            expectEquals (result.countDriftAfterStep, 0);
+        }
+
+        // The loop takes a few ticks to lock, and re-locks after a pause or a
+        // big tempo drop. No tick may go missing or be doubled around that.
+        {
+            beginTest ("Cold start: every tick from the first one is output");
+
+            Scenario scenario;
+            scenario.meanJitterMs = 2.0;
+            scenario.stopAtMs = 10000.0;
+            scenario.durationMs = 12000.0;
+            const auto result = run (scenario);
+
+            expectEquals (result.ticksOut, result.ticksSent);
+        }
+
+        {
+            beginTest ("Stop, 1 s pause, Continue");
+
+            Scenario scenario;
+            scenario.meanJitterMs = 2.0;
+            scenario.pauseAtMs = 6000.0;
+            scenario.pauseForMs = 1000.0;
+            scenario.stopAtMs = 14000.0;
+            scenario.durationMs = 16000.0;
+            const auto result = run (scenario);
+
+            expectEquals (result.ticksOut, result.ticksSent);
+        }
+
+        {
+            beginTest ("Tempo drop 120 -> 60 BPM, which re-acquires");
+
+            Scenario scenario;
+            scenario.stepToBpm = 60.0;
+            scenario.stepAtMs = 6000.0;
+            scenario.meanJitterMs = 2.0;
+            scenario.stopAtMs = 14000.0;
+            scenario.durationMs = 16000.0;
+            const auto result = run (scenario);
+
+            expectEquals (result.ticksOut, result.ticksSent);
+        }
+    }
+
+private:
+    struct Scenario
+    {
+        double bpm = 120.0;
+        double stepToBpm = 0.0;        // 0 = no tempo step
+        double stepAtMs = 20000.0;
+        double meanJitterMs = 0.0;     // exponential, delays only
+        double lossProbability = 0.0;
+        double pauseAtMs = 0.0;        // Stop, silence, then the clock resumes
+        double pauseForMs = 0.0;       // 0 = no pause
+        double stopAtMs = 0.0;         // Stop for good, 0 = runs to the end
+        double durationMs = 40000.0;
+    };
+
+    struct Result
+    {
+        double tempoBpm = 0.0;
+        double tempoBpmAfterStep = 0.0;   // 5 s after the step
+        double inputJitterMs = 0.0, outputJitterMs = 0.0;
+        int countDrift = 0;               // change in (output ticks - true ticks) after settling
+        int countDriftAfterStep = 0;
+        int ticksSent = 0, ticksOut = 0;  // over the whole run
+    };
+
+    struct OffsetAverage
+    {
+        void add (double offset)    { sum += offset; ++count; }
+        double get() const          { return count > 0 ? sum / count : 0.0; }
+
+        double sum = 0.0;
+        int count = 0;
+    };
+
+    static double periodFor (double bpm)
+    {
+        return 60000.0 / (bpm * MidiClockFollower::ticksPerQuarterNote);
+    }
+
+    static Result run (const Scenario& scenario)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 256;
+        constexpr double startMs = 1000.0;
+        constexpr double settleMs = 5000.0;
+
+        juce::Random random (0x3d5);
+
+        auto delay = [&]
+        {
+            return -scenario.meanJitterMs * std::log (1.0 - random.nextDouble());
+        };
+
+        // True tick times and their arrivals, and the arrivals of Stop messages
+        std::vector<double> tickTimes, arrivals, stops;
+
+        double periodMs = periodFor (scenario.bpm);
+
+        auto sendStop = [&]
+        {
+            // Half a period after the last tick, on the same socket, so it never
+            // overtakes that tick. A Stop arriving after the next tick was due
+            // finds that tick already output.
+            const double lastArrivalMs = arrivals.empty() ? 0.0 : *std::max_element (arrivals.begin(), arrivals.end());
+            stops.push_back (juce::jmax (tickTimes.back() + 0.5 * periodMs + delay(), lastArrivalMs));
+        };
+
+        const double pauseStartMs = startMs + scenario.pauseAtMs;
+        const double pauseEndMs = pauseStartMs + scenario.pauseForMs;
+
+        for (double t = startMs; t < startMs + scenario.durationMs;)
+        {
+            if (scenario.pauseForMs > 0.0 && t >= pauseStartMs && t < pauseEndMs)
+            {
+                sendStop();
+                t = pauseEndMs;
+                continue;
+            }
+
+            if (scenario.stopAtMs > 0.0 && t >= startMs + scenario.stopAtMs)
+            {
+                sendStop();
+                break;
+            }
+
+            tickTimes.push_back (t);
+
+            if (random.nextDouble() >= scenario.lossProbability)
+                arrivals.push_back (t + delay());
+
+            const bool afterStep = scenario.stepToBpm > 0.0 && t >= startMs + scenario.stepAtMs;
+            periodMs = periodFor (afterStep ? scenario.stepToBpm : scenario.bpm);
+            t += periodMs;
+        }
+
+        std::sort (arrivals.begin(), arrivals.end());
+
+        auto trueTicksUntil = [&] (double timeMs)
+        {
+            return (juce::int64) (std::upper_bound (tickTimes.begin(), tickTimes.end(), timeMs) - tickTimes.begin());
+        };
+
+        MidiClockFollower follower;
+        follower.prepare (sampleRate);
+        follower.reset();
+
+        Result result;
+        juce::MidiBuffer midi;
+        size_t nextArrival = 0, nextStop = 0;
+        juce::int64 ticksOut = 0;
+
+        // The offset between output and true ticks flips by one as the output
+        // lags the true clock, so it is averaged over a few seconds at a time
+        constexpr double averagingMs = 2000.0;
+        const double stepEndMs = scenario.stepToBpm > 0.0 ? scenario.stepAtMs : scenario.durationMs;
+
+        OffsetAverage settled, beforeStep, afterStep, atEnd;
+
+        const double blockMs = blockSize * 1000.0 / sampleRate;
+
+        for (double now = startMs; now < startMs + scenario.durationMs; now += blockMs)
+        {
+            for (;;)
+            {
+                const bool tickDue = nextArrival < arrivals.size() && arrivals[nextArrival] <= now;
+                const bool stopDue = nextStop < stops.size() && stops[nextStop] <= now;
+
+                if (stopDue && ! (tickDue && arrivals[nextArrival] < stops[nextStop]))
+                {
+                    follower.handleStop();
+                    ++nextStop;
+                }
+                else if (tickDue)
+                    follower.handleClockTick (arrivals[nextArrival++]);
+                else
+                    break;
+            }
+
+            midi.clear();
+            follower.renderBlock (midi, now, blockSize);
+
+            ticksOut += midi.getNumEvents();
+
+            // A lost or phantom tick shows up as a lasting change of this offset
+            const double elapsedMs = now - startMs;
+            const auto offset = (double) (ticksOut - trueTicksUntil (now));
+
+            if (elapsedMs >= settleMs && elapsedMs < settleMs + averagingMs)
+                settled.add (offset);
+
+            // Only compare counts where the tempo is not moving
+            if (elapsedMs >= stepEndMs - averagingMs && elapsedMs < stepEndMs)
+                beforeStep.add (offset);
+
+            if (scenario.stepToBpm > 0.0)
+            {
+                if (elapsedMs >= scenario.stepAtMs + 5000.0 && elapsedMs < scenario.stepAtMs + 5000.0 + averagingMs)
+                {
+                    if (afterStep.count == 0)
+                        result.tempoBpmAfterStep = follower.getTempoBpm();
+
+                    afterStep.add (offset);
+                }
+
+                if (elapsedMs >= scenario.durationMs - averagingMs)
+                    atEnd.add (offset);
+            }
+        }
+
+        result.countDrift = juce::roundToInt (beforeStep.get() - settled.get());
+        result.countDriftAfterStep = juce::roundToInt (atEnd.get() - afterStep.get());
+        result.ticksSent = (int) tickTimes.size();
+        result.ticksOut = (int) ticksOut;
+        result.tempoBpm = follower.getTempoBpm();
+        result.inputJitterMs = follower.getInputJitterMs();
+        result.outputJitterMs = follower.getOutputJitterMs();
+        return result;
+    }
+};
+
+static MidiClockFollowerTests midiClockFollowerTests;
@@ -0,0 +1,25 @@
+/*
+  ==============================================================================
+
+    Runs every juce::UnitTest in the NoiseCommander3DS category. The exit
+    code is non-zero if any test failed, for ctest.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+int main (int, char**)
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTestsInCategory ("NoiseCommander3DS");
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        if (runner.getResult (i)->failures > 0)
+            return 1;
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    Background reader for the UDP link from the 3DS.
+
+  ==============================================================================
+*/
+
+#include "UdpMidiReceiver.h"
+
+//==============================================================================
+UdpMidiReceiver::UdpMidiReceiver (juce::DatagramSocket& socketToReadFrom)
+    : juce::Thread ("3DS UDP receiver"),
+      socket (socketToReadFrom)
+{
+}
+
+UdpMidiReceiver::~UdpMidiReceiver()
+{
+    stop();
+}
+
+void UdpMidiReceiver::start()
+{
+    // Arrival times are only as good as the wake-up latency of this thread
+    startThread (juce::Thread::Priority::highest);
+}
+
+void UdpMidiReceiver::stop()
+{
+    stopThread (1000);
+}
+
+bool UdpMidiReceiver::popPacket (Packet& packet)
+{
+    const auto scope = fifo.read (1);
+
+    if (scope.blockSize1 > 0)
+    {
+        const auto& source = packets[(size_t) scope.startIndex1];
+        packet.arrivalMs = source.arrivalMs;
+        packet.size = source.size;
+        std::memcpy (packet.data, source.data, (size_t) source.size);
+        return true;
+    }
+
+    return false;
+}
+
+void UdpMidiReceiver::run()
+{
+    juce::uint8 buffer[maxPacketSize];
+
+    while (! threadShouldExit())
+    {
+        // Short timeout so stop() never waits long on an idle link
+        if (socket.waitUntilReady (true, 20) != 1)
+            continue;
+
+        const int bytesRead = socket.read (buffer, sizeof (buffer), false);
+        const double arrivalMs = juce::Time::getMillisecondCounterHiRes();
+
+        if (bytesRead <= 0)
+            continue;
+
+        if (packetFilter != nullptr && packetFilter (buffer, bytesRead, arrivalMs))
+            continue;
+
+        const auto scope = fifo.write (1);
+
+        if (scope.blockSize1 > 0)
+        {
+            auto& packet = packets[(size_t) scope.startIndex1];
+            packet.arrivalMs = arrivalMs;
+            packet.size = bytesRead;
+            std::memcpy (packet.data, buffer, (size_t) bytesRead);
+        }
+        else
+        {
+            ++droppedPackets;
+        }
+    }
+}
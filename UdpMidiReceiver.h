@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    Background reader for the UDP link from the 3DS. Datagrams are stamped
+    with Time::getMillisecondCounterHiRes() the moment they arrive and handed
+    to the audio thread through a lock-free FIFO.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <functional>
+
+//==============================================================================
+/**
+*/
+class UdpMidiReceiver  : private juce::Thread
+{
+public:
+    static constexpr int maxPacketSize = 1024;
+    static constexpr int fifoSize = 128;
+
+    struct Packet
+    {
+        double arrivalMs = 0.0;
+        int size = 0;
+        juce::uint8 data[maxPacketSize];
+    };
+
+    explicit UdpMidiReceiver (juce::DatagramSocket& socketToReadFrom);
+    ~UdpMidiReceiver() override;
+
+    void start();
+    void stop();
+
+    // Audio thread only. Returns false once the FIFO is empty.
+    bool popPacket (Packet& packet);
+
+    int getNumDroppedPackets() const noexcept { return droppedPackets.load(); }
+
+    // Called on the receiver thread for every datagram before it is queued.
+    // Return true to consume it, e.g. for non-MIDI control traffic. Set before start().
+    std::function<bool (const juce::uint8* data, int size, double arrivalMs)> packetFilter;
+
+private:
+    void run() override;
+
+    juce::DatagramSocket& socket;
+
+    juce::AbstractFifo fifo { fifoSize };
+    std::array<Packet, fifoSize> packets;
+    std::atomic<int> droppedPackets { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UdpMidiReceiver)
+};